@@ -13,9 +13,15 @@ TEMPLATE = app
 
 
 SOURCES += main.cpp\
-        wittypi2window.cpp
-
-HEADERS  += wittypi2window.h
+        wittypi2window.cpp \
+        alarmevaluator.cpp \
+        schedulescript.cpp \
+        scheduleeditor.cpp
+
+HEADERS  += wittypi2window.h \
+        alarmevaluator.h \
+        schedulescript.h \
+        scheduleeditor.h
 
 FORMS    += wittypi2window.ui
 
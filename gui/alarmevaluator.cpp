@@ -0,0 +1,298 @@
+#include "alarmevaluator.h"
+
+// the longest gap between two matching dates is 61 days (e.g. 31st of March and May)
+#define MAX_SEARCH_DAYS 62
+
+AlarmEvaluator::AlarmEvaluator(Alarm alarm, const QList<int>& registers) :
+    valid(false),
+    cleared(true),
+    secMasked(false),
+    minMasked(false),
+    hourMasked(false),
+    dayMasked(false),
+    matchWeekday(false),
+    sec(0),
+    min(0),
+    hour(0),
+    day(0)
+{
+    int regCount = (alarm == STARTUP_ALARM ? 4 : 3);
+    if (registers.size() != regCount)
+    {
+        return;
+    }
+    valid = true;
+
+    int i = 0;
+    if (alarm == STARTUP_ALARM)
+    {
+        int regSec = registers.at(i++);
+        secMasked = (regSec & 0x80) != 0;
+        sec = bcd2dec(regSec & 0x7F);
+    }
+    // alarm 2 has no seconds register, it always fires at 00 second
+
+    int regMin = registers.at(i++);
+    minMasked = (regMin & 0x80) != 0;
+    min = bcd2dec(regMin & 0x7F);
+
+    int regHour = registers.at(i++);
+    hourMasked = (regHour & 0x80) != 0;
+    hour = decodeHour(regHour);
+
+    int regDay = registers.at(i++);
+    dayMasked = (regDay & 0x80) != 0;
+    matchWeekday = (regDay & 0x40) != 0;
+    day = bcd2dec(regDay & (matchWeekday ? 0x0F : 0x3F));
+
+    // all zero registers is how utilities.sh clears the alarm
+    cleared = true;
+    foreach (int reg, registers)
+    {
+        if (reg != 0)
+        {
+            cleared = false;
+        }
+    }
+}
+
+int AlarmEvaluator::bcd2dec(int bcd)
+{
+    return (bcd >> 4) * 10 + (bcd & 0x0F);
+}
+
+int AlarmEvaluator::decodeHour(int reg)
+{
+    if (reg & 0x40)
+    {
+        // 12-hour mode, bit 5 is AM/PM
+        int h = bcd2dec(reg & 0x1F);
+        if (h < 1 || h > 12)
+        {
+            return -1;
+        }
+        return (h % 12) + ((reg & 0x20) ? 12 : 0);
+    }
+    return bcd2dec(reg & 0x3F);
+}
+
+/**
+ * @brief AlarmEvaluator::hasReadError
+ * @return true if the registers could not be read from RTC
+ */
+bool AlarmEvaluator::hasReadError() const
+{
+    return !valid;
+}
+
+bool AlarmEvaluator::isCleared() const
+{
+    return cleared;
+}
+
+/**
+ * DS3231 only defines the mask combinations that ignore all fields above
+ * the first compared one (e.g. "?? ??:05:00"), others are not documented.
+ *
+ * @brief AlarmEvaluator::isLegalMask
+ * @return true if the mask bits form a documented combination
+ */
+bool AlarmEvaluator::isLegalMask() const
+{
+    bool masks[] = { dayMasked, hourMasked, minMasked, secMasked };
+    bool compared = false;
+    for (int i = 0; i < 4; i++)
+    {
+        if (!masks[i])
+        {
+            compared = true;
+        }
+        else if (compared)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief AlarmEvaluator::isFrequent
+ * @return true if the alarm fires more than once per hour
+ */
+bool AlarmEvaluator::isFrequent() const
+{
+    return valid && !cleared && hasValidFields() && minMasked;
+}
+
+QString AlarmEvaluator::describe() const
+{
+    if (!valid)
+    {
+        return TXT_ALARM_READ_ERROR;
+    }
+    if (cleared)
+    {
+        return TXT_ALARM_NOT_SET;
+    }
+    if (!hasValidFields())
+    {
+        return TXT_ALARM_NEVER;
+    }
+    if (!isLegalMask())
+    {
+        return TXT_ALARM_ILLEGAL_MASK;
+    }
+    if (secMasked)
+    {
+        return TXT_ALARM_EVERY_SECOND;
+    }
+    if (minMasked)
+    {
+        return TXT_ALARM_EVERY_MINUTE;
+    }
+    if (hourMasked)
+    {
+        return TXT_ALARM_EVERY_HOUR;
+    }
+    if (dayMasked)
+    {
+        return TXT_ALARM_EVERY_DAY;
+    }
+    return matchWeekday ? TXT_ALARM_EVERY_WEEK : TXT_ALARM_EVERY_MONTH;
+}
+
+/**
+ * Check the compared fields against their ranges, a field out of range
+ * will never match and the alarm never fires.
+ */
+bool AlarmEvaluator::hasValidFields() const
+{
+    if (!secMasked && (sec < 0 || sec > 59))
+    {
+        return false;
+    }
+    if (!minMasked && (min < 0 || min > 59))
+    {
+        return false;
+    }
+    if (!hourMasked && (hour < 0 || hour > 23))
+    {
+        return false;
+    }
+    if (!dayMasked)
+    {
+        if (matchWeekday && (day < 1 || day > 7))
+        {
+            return false;
+        }
+        if (!matchWeekday && (day < 1 || day > 31))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool AlarmEvaluator::matchDate(const QDate& date) const
+{
+    if (dayMasked)
+    {
+        return true;
+    }
+    if (matchWeekday)
+    {
+        // rtc-ds1307 driver stores day of week as 1 (Sunday) ~ 7 (Saturday)
+        return day == (date.dayOfWeek() % 7) + 1;
+    }
+    return day == date.day();
+}
+
+/**
+ * Find the first matching time of day that is not earlier than fromSecs
+ *
+ * @brief AlarmEvaluator::findTimeInDay
+ * @param fromSecs: seconds since midnight
+ * @param result: the matching time, if found
+ * @return true if found
+ */
+bool AlarmEvaluator::findTimeInDay(int fromSecs, QTime* result) const
+{
+    int fromHour = fromSecs / 3600;
+    int fromMin = (fromSecs / 60) % 60;
+    int fromSec = fromSecs % 60;
+    for (int h = fromHour; h < 24; h++)
+    {
+        if (!hourMasked && h != hour)
+        {
+            continue;
+        }
+        for (int m = (h == fromHour ? fromMin : 0); m < 60; m++)
+        {
+            if (!minMasked && m != min)
+            {
+                continue;
+            }
+            for (int s = (h == fromHour && m == fromMin ? fromSec : 0); s < 60; s++)
+            {
+                if (!secMasked && s != sec)
+                {
+                    continue;
+                }
+                *result = QTime(h, m, s);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief AlarmEvaluator::nextFireTime
+ * @param after: UTC date time
+ * @return the first fire time later than given time, invalid if never fires
+ *         or the mask combination is not documented (DS3231 does not
+ *         guarantee when it fires)
+ */
+QDateTime AlarmEvaluator::nextFireTime(const QDateTime& after) const
+{
+    if (!valid || cleared || !hasValidFields() || !isLegalMask())
+    {
+        return QDateTime();
+    }
+    QDateTime from = after.toUTC().addSecs(1);
+    QDate date = from.date();
+    int fromSecs = QTime(0, 0, 0).secsTo(from.time());
+    for (int i = 0; i < MAX_SEARCH_DAYS; i++)
+    {
+        QTime time;
+        if (matchDate(date) && findTimeInDay(fromSecs, &time))
+        {
+            return QDateTime(date, time, Qt::UTC);
+        }
+        date = date.addDays(1);
+        fromSecs = 0;
+    }
+    return QDateTime();
+}
+
+/**
+ * @brief AlarmEvaluator::nextFireTimes
+ * @param after: UTC date time
+ * @param count: how many fire times to list
+ * @return the next fire times in UTC, fewer than count if alarm never fires
+ */
+QList<QDateTime> AlarmEvaluator::nextFireTimes(const QDateTime& after, int count) const
+{
+    QList<QDateTime> list;
+    QDateTime dt = after;
+    while (list.size() < count)
+    {
+        dt = nextFireTime(dt);
+        if (!dt.isValid())
+        {
+            break;
+        }
+        list << dt;
+    }
+    return list;
+}
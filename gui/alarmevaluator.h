@@ -0,0 +1,73 @@
+#ifndef ALARMEVALUATOR_H
+#define ALARMEVALUATOR_H
+
+#include <QList>
+#include <QString>
+#include <QDateTime>
+
+#define TXT_ALARM_NOT_SET QString("not set")
+#define TXT_ALARM_READ_ERROR QString("unable to read")
+#define TXT_ALARM_NEVER QString("never fires")
+#define TXT_ALARM_EVERY_SECOND QString("every second")
+#define TXT_ALARM_EVERY_MINUTE QString("every minute")
+#define TXT_ALARM_EVERY_HOUR QString("every hour")
+#define TXT_ALARM_EVERY_DAY QString("every day")
+#define TXT_ALARM_EVERY_WEEK QString("every week")
+#define TXT_ALARM_EVERY_MONTH QString("every month")
+#define TXT_ALARM_ILLEGAL_MASK QString("unsupported wildcard pattern")
+
+/**
+ * Models the alarm matching of DS3231, so we can tell when (and how often)
+ * the startup (alarm 1) and shutdown (alarm 2) alarms will actually fire.
+ *
+ * The register values are the raw bytes read from the RTC, which keeps UTC
+ * time, so all date times here are in UTC as well.
+ */
+class AlarmEvaluator
+{
+public:
+    enum Alarm
+    {
+        STARTUP_ALARM,  // alarm 1: registers 0x07~0x0A (sec, min, hour, day/date)
+        SHUTDOWN_ALARM  // alarm 2: registers 0x0B~0x0D (min, hour, day/date)
+    };
+
+    AlarmEvaluator(Alarm alarm, const QList<int>& registers);
+
+    bool hasReadError() const;
+    bool isCleared() const;
+    bool isLegalMask() const;
+    bool isFrequent() const;
+
+    QString describe() const;
+
+    QDateTime nextFireTime(const QDateTime& after) const;
+    QList<QDateTime> nextFireTimes(const QDateTime& after, int count) const;
+
+private:
+    bool valid;
+    bool cleared;
+
+    // A1M1~A1M4 (A2M2~A2M4) bits, true if the field is ignored
+    bool secMasked;
+    bool minMasked;
+    bool hourMasked;
+    bool dayMasked;
+
+    // DY/DT bit: true if matching day of week rather than date
+    bool matchWeekday;
+
+    int sec;
+    int min;
+    int hour;
+    int day;
+
+    static int bcd2dec(int bcd);
+    static int decodeHour(int reg);
+
+    bool hasValidFields() const;
+    bool matchDate(const QDate& date) const;
+    bool findTimeInDay(int fromSecs, QTime* result) const;
+};
+
+#endif // ALARMEVALUATOR_H
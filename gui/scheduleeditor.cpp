@@ -0,0 +1,446 @@
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLineEdit>
+#include <QFile>
+#include <QFileInfo>
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QTextStream>
+#include <QDebug>
+
+#include "scheduleeditor.h"
+#include "wittypi2window.h"
+
+LiveEditDelegate::LiveEditDelegate(QObject *parent) :
+    QStyledItemDelegate(parent)
+{
+}
+
+QWidget* LiveEditDelegate::createEditor(QWidget *parent, const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    QWidget* editor = QStyledItemDelegate::createEditor(parent, option, index);
+    QLineEdit* lineEdit = qobject_cast<QLineEdit*>(editor);
+    if (lineEdit != NULL)
+    {
+        lineEdit->setProperty(PROP_EDIT_ROW, index.row());
+        lineEdit->setProperty(PROP_EDIT_COLUMN, index.column());
+        connect(lineEdit, SIGNAL(textEdited(QString)), this, SLOT(reportText(QString)));
+    }
+    return editor;
+}
+
+void LiveEditDelegate::reportText(const QString& text)
+{
+    QWidget* editor = qobject_cast<QWidget*>(sender());
+    if (editor != NULL)
+    {
+        emit cellEdited(editor->property(PROP_EDIT_ROW).toInt(),
+                        editor->property(PROP_EDIT_COLUMN).toInt(), text);
+    }
+}
+
+ScheduleEditor::ScheduleEditor(QString scriptFile, QString scriptsDir, QWidget *parent) :
+    QWidget(parent),
+    scriptFile(scriptFile),
+    scriptsDir(scriptsDir)
+{
+    beginEdit = new QDateTimeEdit(this);
+    beginEdit->setDisplayFormat(TXT_EDITOR_DATETIME_FORMAT);
+    beginEdit->setCalendarPopup(true);
+    beginEdit->setDateTimeRange(WPI_MIN_DATETIME, WPI_MAX_DATETIME);
+    endEdit = new QDateTimeEdit(this);
+    endEdit->setDisplayFormat(TXT_EDITOR_DATETIME_FORMAT);
+    endEdit->setCalendarPopup(true);
+    endEdit->setDateTimeRange(WPI_MIN_DATETIME, WPI_MAX_DATETIME);
+
+    QHBoxLayout* timeLayout = new QHBoxLayout();
+    timeLayout->addWidget(new QLabel(TXT_BEGIN, this));
+    timeLayout->addWidget(beginEdit, 1);
+    timeLayout->addWidget(new QLabel(TXT_END, this));
+    timeLayout->addWidget(endEdit, 1);
+
+    table = new QTableWidget(0, 3, this);
+    table->setHorizontalHeaderLabels(QStringList() << TXT_STATE << TXT_DURATION << TXT_WAIT);
+    table->horizontalHeader()->setStretchLastSection(true);
+    table->setSelectionBehavior(QAbstractItemView::SelectRows);
+    table->setSelectionMode(QAbstractItemView::SingleSelection);
+    LiveEditDelegate* delegate = new LiveEditDelegate(table);
+    table->setItemDelegate(delegate);
+    table->setMinimumHeight(150);
+
+    QPushButton* addButton = new QPushButton(TXT_ADD_STATE, this);
+    QPushButton* removeButton = new QPushButton(TXT_REMOVE_STATE, this);
+    QPushButton* loadButton = new QPushButton(TXT_LOAD_SCRIPT, this);
+    QPushButton* saveButton = new QPushButton(TXT_SAVE_SCRIPT, this);
+    QPushButton* applyButton = new QPushButton(TXT_APPLY_SCRIPT, this);
+
+    QHBoxLayout* buttonLayout = new QHBoxLayout();
+    buttonLayout->addWidget(addButton);
+    buttonLayout->addWidget(removeButton);
+    buttonLayout->addStretch();
+    buttonLayout->addWidget(loadButton);
+    buttonLayout->addWidget(saveButton);
+    buttonLayout->addWidget(applyButton);
+
+    summaryLabel = new QLabel(this);
+    summaryLabel->setWordWrap(true);
+    summaryLabel->setTextFormat(Qt::RichText);
+
+    QVBoxLayout* layout = new QVBoxLayout(this);
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->addLayout(timeLayout);
+    layout->addWidget(table);
+    layout->addLayout(buttonLayout);
+    layout->addWidget(summaryLabel);
+
+    connect(table, SIGNAL(itemChanged(QTableWidgetItem*)), this, SLOT(onItemChanged(QTableWidgetItem*)));
+    connect(delegate, SIGNAL(cellEdited(int,int,QString)), this, SLOT(onCellEdited(int,int,QString)));
+    connect(delegate, SIGNAL(closeEditor(QWidget*,QAbstractItemDelegate::EndEditHint)), this, SLOT(onEditorClosed(QWidget*)));
+    connect(beginEdit, SIGNAL(dateTimeChanged(QDateTime)), this, SLOT(onBeginChanged(QDateTime)));
+    connect(endEdit, SIGNAL(dateTimeChanged(QDateTime)), this, SLOT(onEndChanged(QDateTime)));
+    connect(addButton, SIGNAL(clicked()), this, SLOT(addState()));
+    connect(removeButton, SIGNAL(clicked()), this, SLOT(removeState()));
+    connect(loadButton, SIGNAL(clicked()), this, SLOT(loadScript()));
+    connect(saveButton, SIGNAL(clicked()), this, SLOT(saveScript()));
+    connect(applyButton, SIGNAL(clicked()), this, SLOT(applyScript()));
+
+    // edit the schedule script in use, or start with a simple one
+    if (!QFileInfo(scriptFile).isFile() || !loadFile(scriptFile))
+    {
+        QDateTime today(QDate::currentDate(), QTime(0, 0, 0));
+        beginEdit->setDateTime(today);
+        endEdit->setDateTime(today.addYears(10).addSecs(-1));
+        table->blockSignals(true);
+        table->setRowCount(2);
+        setRow(0, "ON", "M5", false);
+        setRow(1, "OFF", "M15", false);
+        table->blockSignals(false);
+        QList<ScheduleState> states;
+        states << parseRow(0) << parseRow(1);
+        script.setStates(states);
+    }
+    refreshSummary();
+}
+
+void ScheduleEditor::setRow(int row, QString type, QString duration, bool wait)
+{
+    table->setItem(row, COLUMN_STATE, new QTableWidgetItem(type));
+    table->setItem(row, COLUMN_DURATION, new QTableWidgetItem(duration));
+    QTableWidgetItem* waitItem = new QTableWidgetItem();
+    waitItem->setFlags(Qt::ItemIsEnabled | Qt::ItemIsSelectable | Qt::ItemIsUserCheckable);
+    waitItem->setCheckState(wait ? Qt::Checked : Qt::Unchecked);
+    table->setItem(row, COLUMN_WAIT, waitItem);
+}
+
+/**
+ * @brief ScheduleEditor::parseRow
+ * @param row
+ * @param editColumn: column being edited, whose text is not committed yet
+ * @param editText: current text in the cell editor
+ * @return the parsed state
+ */
+ScheduleState ScheduleEditor::parseRow(int row, int editColumn, QString editText) const
+{
+    QTableWidgetItem* typeItem = table->item(row, COLUMN_STATE);
+    QTableWidgetItem* durationItem = table->item(row, COLUMN_DURATION);
+    QTableWidgetItem* waitItem = table->item(row, COLUMN_WAIT);
+    QString type = (editColumn == COLUMN_STATE ? editText : (typeItem ? typeItem->text() : QString()));
+    QString duration = (editColumn == COLUMN_DURATION ? editText : (durationItem ? durationItem->text() : QString()));
+    return ScheduleScript::parseState(type, duration,
+                waitItem && waitItem->checkState() == Qt::Checked);
+}
+
+/**
+ * Re-validate the changed row only, and mark it if it is not recognized
+ *
+ * @brief ScheduleEditor::updateRow
+ * @param row
+ */
+void ScheduleEditor::updateRow(int row)
+{
+    ScheduleState state = parseRow(row);
+    script.setState(row, state);
+    table->blockSignals(true);
+    for (int col = COLUMN_STATE; col <= COLUMN_DURATION; col++)
+    {
+        QTableWidgetItem* item = table->item(row, col);
+        if (item != NULL)
+        {
+            item->setForeground(state.valid ? table->palette().text() : QBrush(Qt::red));
+        }
+    }
+    table->blockSignals(false);
+}
+
+bool ScheduleEditor::loadFile(QString fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QFile::ReadOnly | QFile::Text))
+    {
+        qDebug() << "Schedule script file open failed: " << fileName;
+        return false;
+    }
+    QDateTime begin;
+    QDateTime end;
+    QList<QStringList> rows;
+    QTextStream in(&file);
+    while (!in.atEnd())
+    {
+        QString keyword;
+        QString args;
+        if (!ScheduleScript::parseLine(in.readLine(), &keyword, &args))
+        {
+            continue;
+        }
+        if (keyword == "BEGIN")
+        {
+            begin = QDateTime::fromString(args, WPI_DATETIME_FORMAT);
+        }
+        else if (keyword == "END")
+        {
+            end = QDateTime::fromString(args, WPI_DATETIME_FORMAT);
+        }
+        else
+        {
+            QString wait;
+            if (args == TXT_WAIT || args.endsWith(QString(" ") + TXT_WAIT))
+            {
+                args.chop(TXT_WAIT.length());
+                wait = TXT_WAIT;
+            }
+            rows << (QStringList() << keyword << args.trimmed() << wait);
+        }
+    }
+
+    beginEdit->blockSignals(true);
+    endEdit->blockSignals(true);
+    beginEdit->setDateTime(begin.isValid() ? begin : QDateTime(QDate::currentDate(), QTime(0, 0, 0)));
+    endEdit->setDateTime(end.isValid() ? end : beginEdit->dateTime().addYears(10).addSecs(-1));
+    beginEdit->blockSignals(false);
+    endEdit->blockSignals(false);
+    script.setBegin(beginEdit->dateTime());
+    script.setEnd(endEdit->dateTime());
+
+    table->blockSignals(true);
+    table->setRowCount(rows.size());
+    QList<ScheduleState> states;
+    for (int i = 0; i < rows.size(); i++)
+    {
+        const QStringList& row = rows.at(i);
+        setRow(i, row.at(0), row.at(1), !row.at(2).isEmpty());
+        states << parseRow(i);
+    }
+    table->blockSignals(false);
+    script.setStates(states);
+    for (int i = 0; i < states.size(); i++)
+    {
+        if (!states.at(i).valid)
+        {
+            updateRow(i);
+        }
+    }
+    refreshSummary();
+    return true;
+}
+
+QString ScheduleEditor::toText() const
+{
+    QString text;
+    QTextStream out(&text);
+    out << "BEGIN\t" << beginEdit->dateTime().toString(WPI_DATETIME_FORMAT) << "\n";
+    out << "END\t" << endEdit->dateTime().toString(WPI_DATETIME_FORMAT) << "\n";
+    for (int row = 0; row < table->rowCount(); row++)
+    {
+        QTableWidgetItem* typeItem = table->item(row, COLUMN_STATE);
+        QTableWidgetItem* durationItem = table->item(row, COLUMN_DURATION);
+        QTableWidgetItem* waitItem = table->item(row, COLUMN_WAIT);
+        out << (typeItem ? typeItem->text().trimmed() : QString());
+        out << "\t" << (durationItem ? durationItem->text().trimmed() : QString());
+        if (waitItem && waitItem->checkState() == Qt::Checked)
+        {
+            out << " " << TXT_WAIT;
+        }
+        out << "\n";
+    }
+    out.flush();
+    return text;
+}
+
+bool ScheduleEditor::writeFile(QString fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate | QFile::Text))
+    {
+        QMessageBox::warning(this, TXT_WINDOW_TITLE, TXT_SAVE_FAILED + fileName);
+        return false;
+    }
+    QTextStream out(&file);
+    out << toText();
+    return true;
+}
+
+void ScheduleEditor::refreshSummary()
+{
+    QDateTime now = QDateTime::currentDateTime();
+    QString html;
+    foreach (QString error, script.errors(now))
+    {
+        html += QString("<font color=\"red\">") + error + QString("</font><br/>");
+    }
+    qint64 cycle = script.cycleLength();
+    if (cycle > 0)
+    {
+        html += QString("Cycle: %1 (%2 states), ON %3, duty cycle %4%<br/>")
+                .arg(ScheduleScript::formatDuration(cycle))
+                .arg(script.stateCount())
+                .arg(ScheduleScript::formatDuration(script.onLength()))
+                .arg(script.onLength() * 100.0 / cycle, 0, 'f', 1);
+    }
+    QList<ScheduleTransition> transitions = script.nextTransitions(now, NEXT_TRANSITIONS_COUNT);
+    if (!transitions.isEmpty())
+    {
+        QStringList parts;
+        foreach (ScheduleTransition transition, transitions)
+        {
+            parts << QString("%1 %2 %3")
+                     .arg(transition.on ? "ON" : "OFF")
+                     .arg(transition.external ? "after" : "at")
+                     .arg(transition.time.toString(TXT_EDITOR_DATETIME_FORMAT));
+        }
+        html += QString("Next: ") + parts.join(", ") + QString("<br/>");
+    }
+    if (script.end().isValid())
+    {
+        html += QString("Expires at ") + script.end().toString(TXT_EDITOR_DATETIME_FORMAT);
+    }
+    summaryLabel->setText(html);
+}
+
+void ScheduleEditor::onItemChanged(QTableWidgetItem* item)
+{
+    updateRow(item->row());
+    refreshSummary();
+}
+
+/**
+ * Re-validate the row being edited without touching the table, the row
+ * gets marked when the edit is committed
+ *
+ * @brief ScheduleEditor::onCellEdited
+ * @param row
+ * @param column
+ * @param text: current text in the cell editor
+ */
+void ScheduleEditor::onCellEdited(int row, int column, const QString& text)
+{
+    if (row < 0 || row >= script.stateCount())
+    {
+        return;
+    }
+    script.setState(row, parseRow(row, column, text));
+    refreshSummary();
+}
+
+/**
+ * Sync the row with the table when editing ends, the edit may have been
+ * cancelled and the table still keeps the old text
+ *
+ * @brief ScheduleEditor::onEditorClosed
+ * @param editor
+ */
+void ScheduleEditor::onEditorClosed(QWidget* editor)
+{
+    int row = editor->property(PROP_EDIT_ROW).toInt();
+    if (editor->property(PROP_EDIT_ROW).isValid() && row < script.stateCount())
+    {
+        updateRow(row);
+        refreshSummary();
+    }
+}
+
+void ScheduleEditor::onBeginChanged(const QDateTime& dt)
+{
+    script.setBegin(dt);
+    refreshSummary();
+}
+
+void ScheduleEditor::onEndChanged(const QDateTime& dt)
+{
+    script.setEnd(dt);
+    refreshSummary();
+}
+
+void ScheduleEditor::addState()
+{
+    int row = table->currentRow() + 1;
+    if (row <= 0)
+    {
+        row = table->rowCount();
+    }
+    // alternate with the state above
+    QString type("ON");
+    if (row > 0 && row <= script.stateCount() && script.state(row - 1).on)
+    {
+        type = QString("OFF");
+    }
+    table->blockSignals(true);
+    table->insertRow(row);
+    setRow(row, type, "M5", false);
+    table->blockSignals(false);
+    script.insertState(row, parseRow(row));
+    table->setCurrentCell(row, COLUMN_DURATION);
+    refreshSummary();
+}
+
+void ScheduleEditor::removeState()
+{
+    int row = table->currentRow();
+    if (row < 0)
+    {
+        return;
+    }
+    table->blockSignals(true);
+    table->removeRow(row);
+    table->blockSignals(false);
+    script.removeState(row);
+    refreshSummary();
+}
+
+void ScheduleEditor::loadScript()
+{
+    QString fileName(QFileDialog::getOpenFileName(this,
+        TXT_CHOOSE_SCRIPT, scriptsDir, TXT_SCRIPT_FILETYPE, NULL, QFileDialog::DontUseNativeDialog));
+    if (!fileName.isEmpty())
+    {
+        loadFile(fileName);
+    }
+}
+
+void ScheduleEditor::saveScript()
+{
+    QString fileName(QFileDialog::getSaveFileName(this,
+        TXT_SAVE_SCRIPT, scriptsDir, TXT_SCRIPT_FILETYPE, NULL, QFileDialog::DontUseNativeDialog));
+    if (!fileName.isEmpty())
+    {
+        writeFile(fileName);
+    }
+}
+
+void ScheduleEditor::applyScript()
+{
+    if (!script.errors(QDateTime::currentDateTime()).isEmpty())
+    {
+        QMessageBox::StandardButton reply;
+        reply = QMessageBox::question(this, TXT_PLEASE_CONFIRM, TXT_APPLY_WITH_ERRORS,
+            QMessageBox::Yes|QMessageBox::No);
+        if (reply != QMessageBox::Yes)
+        {
+            return;
+        }
+    }
+    if (writeFile(scriptFile))
+    {
+        emit scriptApplied();
+    }
+}
@@ -0,0 +1,106 @@
+#ifndef SCHEDULEEDITOR_H
+#define SCHEDULEEDITOR_H
+
+#include <QWidget>
+#include <QStyledItemDelegate>
+#include <QTableWidget>
+#include <QDateTimeEdit>
+#include <QPushButton>
+#include <QLabel>
+
+#include "schedulescript.h"
+
+#define COLUMN_STATE 0
+#define COLUMN_DURATION 1
+#define COLUMN_WAIT 2
+
+#define PROP_EDIT_ROW "editRow"
+#define PROP_EDIT_COLUMN "editColumn"
+
+#define NEXT_TRANSITIONS_COUNT 4
+
+#define TXT_STATE QString("State")
+#define TXT_DURATION QString("Duration")
+#define TXT_WAIT QString("WAIT")
+#define TXT_BEGIN QString("Begin:")
+#define TXT_END QString("End:")
+#define TXT_ADD_STATE QString("Add")
+#define TXT_REMOVE_STATE QString("Remove")
+#define TXT_LOAD_SCRIPT QString("Load...")
+#define TXT_SAVE_SCRIPT QString("Save As...")
+#define TXT_APPLY_SCRIPT QString("Apply")
+#define TXT_APPLY_WITH_ERRORS QString("The script has problems, apply it anyway?")
+#define TXT_SAVE_FAILED QString("Can not write file: ")
+#define TXT_EDITOR_DATETIME_FORMAT QString("dd/MM/yyyy HH:mm:ss")
+
+/**
+ * Reports the cell editor text on every keystroke, so the script gets
+ * re-validated while typing. The text is only committed to the table
+ * when editing is finished, so the editor keeps its cursor and undo history.
+ */
+class LiveEditDelegate : public QStyledItemDelegate
+{
+    Q_OBJECT
+
+public:
+    explicit LiveEditDelegate(QObject *parent = 0);
+
+    QWidget* createEditor(QWidget *parent, const QStyleOptionViewItem &option, const QModelIndex &index) const;
+
+signals:
+    void cellEdited(int row, int column, const QString& text);
+
+private slots:
+    void reportText(const QString& text);
+};
+
+/**
+ * Editor pane for .wpi schedule script, each edit only re-validates the
+ * changed state.
+ */
+class ScheduleEditor : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit ScheduleEditor(QString scriptFile, QString scriptsDir, QWidget *parent = 0);
+
+    bool loadFile(QString fileName);
+    QString toText() const;
+
+public slots:
+    void refreshSummary();
+
+signals:
+    void scriptApplied();
+
+private slots:
+    void onItemChanged(QTableWidgetItem* item);
+    void onCellEdited(int row, int column, const QString& text);
+    void onEditorClosed(QWidget* editor);
+    void onBeginChanged(const QDateTime& dt);
+    void onEndChanged(const QDateTime& dt);
+    void addState();
+    void removeState();
+    void loadScript();
+    void saveScript();
+    void applyScript();
+
+private:
+    QString scriptFile;
+    QString scriptsDir;
+
+    ScheduleScript script;
+
+    QDateTimeEdit* beginEdit;
+    QDateTimeEdit* endEdit;
+    QTableWidget* table;
+    QLabel* summaryLabel;
+
+    void setRow(int row, QString type, QString duration, bool wait);
+    ScheduleState parseRow(int row, int editColumn=-1, QString editText=QString()) const;
+    void updateRow(int row);
+    bool writeFile(QString fileName);
+};
+
+#endif // SCHEDULEEDITOR_H
@@ -0,0 +1,393 @@
+#include <QRegExp>
+
+#include "schedulescript.h"
+
+ScheduleScript::ScheduleScript() :
+    totalLength(0),
+    totalOnLength(0),
+    onCount(0),
+    offCount(0),
+    invalidCount(0)
+{
+}
+
+QDateTime ScheduleScript::begin() const
+{
+    return beginTime;
+}
+
+QDateTime ScheduleScript::end() const
+{
+    return endTime;
+}
+
+void ScheduleScript::setBegin(const QDateTime& dt)
+{
+    beginTime = dt;
+}
+
+void ScheduleScript::setEnd(const QDateTime& dt)
+{
+    endTime = dt;
+}
+
+int ScheduleScript::stateCount() const
+{
+    return states.size();
+}
+
+ScheduleState ScheduleScript::state(int index) const
+{
+    return states.at(index);
+}
+
+/**
+ * Replace one state, only the totals and the tree path of that state
+ * get updated.
+ *
+ * @brief ScheduleScript::setState
+ * @param index
+ * @param state
+ */
+void ScheduleScript::setState(int index, const ScheduleState& state)
+{
+    const ScheduleState& old = states.at(index);
+    tally(old, -1);
+    tally(state, 1);
+    qint64 delta = (state.valid ? state.duration : 0) - (old.valid ? old.duration : 0);
+    states[index] = state;
+    if (delta != 0)
+    {
+        treeAdd(index, delta);
+    }
+}
+
+void ScheduleScript::insertState(int index, const ScheduleState& state)
+{
+    states.insert(index, state);
+    tally(state, 1);
+    rebuild();
+}
+
+void ScheduleScript::removeState(int index)
+{
+    tally(states.at(index), -1);
+    states.removeAt(index);
+    rebuild();
+}
+
+void ScheduleScript::setStates(const QList<ScheduleState>& list)
+{
+    states = list;
+    totalLength = 0;
+    totalOnLength = 0;
+    onCount = 0;
+    offCount = 0;
+    invalidCount = 0;
+    foreach (ScheduleState state, states)
+    {
+        tally(state, 1);
+    }
+    rebuild();
+}
+
+qint64 ScheduleScript::cycleLength() const
+{
+    return totalLength;
+}
+
+qint64 ScheduleScript::onLength() const
+{
+    return totalOnLength;
+}
+
+void ScheduleScript::tally(const ScheduleState& state, int sign)
+{
+    if (!state.valid)
+    {
+        invalidCount += sign;
+        return;
+    }
+    totalLength += sign * state.duration;
+    if (state.on)
+    {
+        totalOnLength += sign * state.duration;
+        onCount += sign;
+    }
+    else
+    {
+        offCount += sign;
+    }
+}
+
+void ScheduleScript::rebuild()
+{
+    int n = states.size();
+    tree.fill(0, n + 1);
+    for (int i = 1; i <= n; i++)
+    {
+        const ScheduleState& state = states.at(i - 1);
+        tree[i] += (state.valid ? state.duration : 0);
+        int parent = i + (i & -i);
+        if (parent <= n)
+        {
+            tree[parent] += tree[i];
+        }
+    }
+}
+
+void ScheduleScript::treeAdd(int index, qint64 delta)
+{
+    for (int i = index + 1; i < tree.size(); i += (i & -i))
+    {
+        tree[i] += delta;
+    }
+}
+
+/**
+ * @brief ScheduleScript::treePrefix
+ * @param count: how many states from the beginning
+ * @return total duration of these states
+ */
+qint64 ScheduleScript::treePrefix(int count) const
+{
+    qint64 sum = 0;
+    for (int i = count; i > 0; i -= (i & -i))
+    {
+        sum += tree.at(i);
+    }
+    return sum;
+}
+
+/**
+ * @brief ScheduleScript::treeFind
+ * @param offset: seconds since the beginning of cycle, less than cycle length
+ * @return index of the state that covers the offset
+ */
+int ScheduleScript::treeFind(qint64 offset) const
+{
+    int n = tree.size() - 1;
+    int step = 1;
+    while (step * 2 <= n)
+    {
+        step *= 2;
+    }
+    int pos = 0;
+    for (; step > 0; step /= 2)
+    {
+        if (pos + step <= n && tree.at(pos + step) <= offset)
+        {
+            pos += step;
+            offset -= tree.at(pos);
+        }
+    }
+    return pos;
+}
+
+/**
+ * Validate the script as runScript.sh does, and report problems with the
+ * same messages that runScript.sh logs
+ *
+ * @brief ScheduleScript::errors
+ * @param now
+ * @return list of error messages, empty if the script is good
+ */
+QStringList ScheduleScript::errors(const QDateTime& now) const
+{
+    QStringList list;
+    if (!beginTime.isValid())
+    {
+        list << TXT_NO_BEGIN;
+    }
+    if (!endTime.isValid())
+    {
+        list << TXT_NO_END;
+    }
+    if (beginTime.isValid() && endTime.isValid())
+    {
+        if (endTime <= beginTime)
+        {
+            list << TXT_END_BEFORE_BEGIN;
+        }
+        else if (endTime <= now)
+        {
+            list << TXT_ENDED;
+        }
+    }
+    if (states.isEmpty())
+    {
+        list << TXT_NO_STATE;
+        return list;
+    }
+    if (invalidCount > 0)
+    {
+        list << TXT_BAD_STATES.arg(invalidCount);
+    }
+    if (offCount == 0)
+    {
+        list << TXT_NO_OFF_STATE;
+    }
+    if (onCount == 0)
+    {
+        list << TXT_NO_ON_STATE;
+    }
+    if (onCount > 0 && offCount > 0 && totalLength <= 0)
+    {
+        list << TXT_ZERO_CYCLE;
+    }
+    return list;
+}
+
+/**
+ * Find the upcoming state transitions, O(log n) to locate current state
+ * plus O(1) for each transition
+ *
+ * @brief ScheduleScript::nextTransitions
+ * @param now
+ * @param count: how many transitions to list
+ * @return transitions before the end time
+ */
+QList<ScheduleTransition> ScheduleScript::nextTransitions(const QDateTime& now, int count) const
+{
+    QList<ScheduleTransition> list;
+    if (!beginTime.isValid() || !endTime.isValid() || totalLength <= 0
+            || onCount == 0 || offCount == 0)
+    {
+        return list;
+    }
+    qint64 begin = beginTime.toTime_t();
+    qint64 end = endTime.toTime_t();
+    qint64 cur = qMax(begin, (qint64)now.toTime_t());
+    if (cur >= end)
+    {
+        return list;
+    }
+    qint64 offset = (cur - begin) % totalLength;
+    int index = treeFind(offset);
+    qint64 time = cur - offset + treePrefix(index + 1);
+    int n = states.size();
+    while (list.size() < count && time < end)
+    {
+        bool external = states.at(index).wait;
+        index = (index + 1) % n;
+        const ScheduleState& next = states.at(index);
+        if (next.valid && next.duration > 0)
+        {
+            ScheduleTransition transition;
+            transition.time = QDateTime::fromTime_t(time);
+            transition.on = next.on;
+            transition.external = external;
+            list << transition;
+        }
+        time += (next.valid ? next.duration : 0);
+    }
+    return list;
+}
+
+ScheduleState ScheduleScript::parseState(QString type, QString duration, bool wait)
+{
+    ScheduleState state;
+    type = type.trimmed();
+    state.on = (type == "ON");
+    state.wait = wait;
+    bool ok;
+    state.duration = parseDuration(duration, &ok);
+    state.valid = ok && (type == "ON" || type == "OFF");
+    return state;
+}
+
+/**
+ * Parse the duration, such as "D1 H2 M3 S10"
+ *
+ * @brief ScheduleScript::parseDuration
+ * @param duration
+ * @param ok: false if any part can not be recognized
+ * @return duration in seconds
+ */
+qint64 ScheduleScript::parseDuration(QString duration, bool* ok)
+{
+    static const QRegExp partReg("^([DHMS])([0-9]+)$");
+    qint64 seconds = 0;
+    bool good = true;
+    QStringList parts = duration.split(QRegExp("\\s+"), QString::SkipEmptyParts);
+    foreach (QString part, parts)
+    {
+        QRegExp reg(partReg);
+        if (!reg.exactMatch(part))
+        {
+            good = false;
+            continue;
+        }
+        qint64 value = reg.cap(2).toLongLong();
+        QChar unit = reg.cap(1).at(0);
+        if (unit == 'D')
+        {
+            seconds += value * 86400;
+        }
+        else if (unit == 'H')
+        {
+            seconds += value * 3600;
+        }
+        else if (unit == 'M')
+        {
+            seconds += value * 60;
+        }
+        else
+        {
+            seconds += value;
+        }
+    }
+    if (ok != NULL)
+    {
+        *ok = good;
+    }
+    return seconds;
+}
+
+QString ScheduleScript::formatDuration(qint64 seconds)
+{
+    QStringList parts;
+    if (seconds >= 86400)
+    {
+        parts << QString::number(seconds / 86400) + "d";
+    }
+    if (seconds % 86400 >= 3600)
+    {
+        parts << QString::number(seconds % 86400 / 3600) + "h";
+    }
+    if (seconds % 3600 >= 60)
+    {
+        parts << QString::number(seconds % 3600 / 60) + "m";
+    }
+    if (seconds % 60 > 0 || parts.isEmpty())
+    {
+        parts << QString::number(seconds % 60) + "s";
+    }
+    return parts.join(" ");
+}
+
+/**
+ * Split a line in .wpi file into keyword and arguments, comment is removed
+ *
+ * @brief ScheduleScript::parseLine
+ * @param line
+ * @param keyword: e.g. "BEGIN", "ON"
+ * @param args: e.g. "2015-08-01 00:00:00", "M5 WAIT"
+ * @return false if nothing left in the line
+ */
+bool ScheduleScript::parseLine(QString line, QString* keyword, QString* args)
+{
+    int cpos = line.indexOf('#');
+    if (cpos >= 0)
+    {
+        line = line.left(cpos);
+    }
+    QStringList parts = line.trimmed().split(QRegExp("\\s+"), QString::SkipEmptyParts);
+    if (parts.isEmpty())
+    {
+        return false;
+    }
+    *keyword = parts.takeFirst();
+    *args = parts.join(" ");
+    return true;
+}
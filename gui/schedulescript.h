@@ -0,0 +1,97 @@
+#ifndef SCHEDULESCRIPT_H
+#define SCHEDULESCRIPT_H
+
+#include <QList>
+#include <QVector>
+#include <QString>
+#include <QStringList>
+#include <QDateTime>
+
+#define WPI_DATETIME_FORMAT QString("yyyy-MM-dd HH:mm:ss")
+
+// runScript.sh only accepts years 2010~2099
+#define WPI_MIN_DATETIME QDateTime(QDate(2010, 1, 1), QTime(0, 0, 0))
+#define WPI_MAX_DATETIME QDateTime(QDate(2099, 12, 31), QTime(23, 59, 59))
+
+#define TXT_NO_BEGIN QString("I can not find the begin time in the script...")
+#define TXT_NO_END QString("I can not find the end time in the script...")
+#define TXT_NO_STATE QString("I can not find any state defined in the script.")
+#define TXT_NO_OFF_STATE QString("I need at least one OFF state in the script.")
+#define TXT_NO_ON_STATE QString("I need at least one ON state in the script.")
+#define TXT_ENDED QString("The schedule script has ended already.")
+#define TXT_END_BEFORE_BEGIN QString("The end time should be later than the begin time.")
+#define TXT_ZERO_CYCLE QString("The states should last longer than 0 second.")
+#define TXT_BAD_STATES QString("I can not recognize %1 state(s) in the script.")
+
+struct ScheduleState
+{
+    bool valid;
+    bool on;
+    bool wait;
+    qint64 duration;    // in seconds
+};
+
+struct ScheduleTransition
+{
+    QDateTime time;
+    bool on;            // true if turning on
+    bool external;      // true if it should be done externally (WAIT)
+};
+
+/**
+ * Model of a .wpi schedule script, which validates the script in the same
+ * way as runScript.sh does.
+ *
+ * The state durations are kept in a Fenwick tree, so changing a state only
+ * costs O(log n), and so does finding the state at any point of the cycle.
+ * Inserting or removing a state rebuilds the tree in O(n).
+ */
+class ScheduleScript
+{
+public:
+    ScheduleScript();
+
+    QDateTime begin() const;
+    QDateTime end() const;
+    void setBegin(const QDateTime& dt);
+    void setEnd(const QDateTime& dt);
+
+    int stateCount() const;
+    ScheduleState state(int index) const;
+    void setState(int index, const ScheduleState& state);
+    void insertState(int index, const ScheduleState& state);
+    void removeState(int index);
+    void setStates(const QList<ScheduleState>& states);
+
+    qint64 cycleLength() const;
+    qint64 onLength() const;
+
+    QStringList errors(const QDateTime& now) const;
+    QList<ScheduleTransition> nextTransitions(const QDateTime& now, int count) const;
+
+    static ScheduleState parseState(QString type, QString duration, bool wait);
+    static qint64 parseDuration(QString duration, bool* ok=NULL);
+    static QString formatDuration(qint64 seconds);
+    static bool parseLine(QString line, QString* keyword, QString* args);
+
+private:
+    QDateTime beginTime;
+    QDateTime endTime;
+
+    QList<ScheduleState> states;
+    QVector<qint64> tree;   // 1-based Fenwick tree of valid state durations
+
+    qint64 totalLength;
+    qint64 totalOnLength;
+    int onCount;
+    int offCount;
+    int invalidCount;
+
+    void tally(const ScheduleState& state, int sign);
+    void rebuild();
+    void treeAdd(int index, qint64 delta);
+    qint64 treePrefix(int count) const;
+    int treeFind(qint64 offset) const;
+};
+
+#endif // SCHEDULESCRIPT_H
@@ -44,6 +44,7 @@ WittyPi2Window::WittyPi2Window(QWidget *parent) :
     scriptLabel = findChild<QLabel*>("scriptLabel");
     clearScriptButton = findChild<QPushButton*>("clearScriptButton");
     chooseScriptButton = findChild<QPushButton*>("chooseScriptButton");
+    editScriptButton = findChild<QPushButton*>("editScriptButton");
 
     shutdownDateEdit = findChild<QLineEdit*>("shutdownDateEdit");
     shutdownHourEdit = findChild<QLineEdit*>("shutdownHourEdit");
@@ -59,8 +60,22 @@ WittyPi2Window::WittyPi2Window(QWidget *parent) :
     clearStartupButton = findChild<QPushButton*>("clearStartupButton");
     editStartupButton = findChild<QPushButton*>("editStartupButton");
 
+    shutdownAlarmLabel = findChild<QLabel*>("shutdownAlarmLabel");
+    startupAlarmLabel = findChild<QLabel*>("startupAlarmLabel");
+
+    cycleStatsLabel = findChild<QLabel*>("cycleStatsLabel");
+
+    // schedule script editor pane, hidden until needed
+    scheduleEditor = new ScheduleEditor(WITTYPI_SCHEDULE, WITTYPI_SCHEDULES, this);
+    ui->gridLayout->addWidget(scheduleEditor, 15, 0, 1, 6);
+    scheduleEditor->hide();
+    connect(scheduleEditor, SIGNAL(scriptApplied()), this, SLOT(scheduleScriptApplied()));
+
     enableButtons();
 
+    // cycle statistics only change after boot or (re)scheduling
+    reloadCycleStats();
+
     // update display regularly
     timerPaused = false;
     timerEvent(NULL);
@@ -91,6 +106,7 @@ void WittyPi2Window::enableButtons()
 
     chooseScriptButton->setEnabled(true);
     clearScriptButton->setEnabled(usingScript());
+    editScriptButton->setEnabled(true);
 
     QApplication::processEvents();
 }
@@ -112,6 +128,7 @@ void WittyPi2Window::disableButtons()
 
     chooseScriptButton->setEnabled(false);
     clearScriptButton->setEnabled(false);
+    editScriptButton->setEnabled(false);
 
     QApplication::processEvents();
 }
@@ -227,6 +244,84 @@ QList<QString> WittyPi2Window::parseDateTimeString(QString datetime, int mode)
     return list;
 }
 
+/**
+ * Parse the raw register values, which are hex strings separated by spaces
+ *
+ * @brief WittyPi2Window::parseRegisterString
+ * @param registers: e.g. "0x00 0x80 0x80 0x80"
+ * @return empty list if any value can not be parsed
+ */
+QList<int> WittyPi2Window::parseRegisterString(QString registers)
+{
+    QList<int> list;
+    QStringList parts = registers.trimmed().split(' ', QString::SkipEmptyParts);
+    foreach (QString part, parts)
+    {
+        bool ok;
+        int value = part.toInt(&ok, 0);
+        if (!ok)
+        {
+            qDebug() << "Register string parsing error: " + registers;
+            list.clear();
+            break;
+        }
+        list << value;
+    }
+    return list;
+}
+
+/**
+ * Format the alarm registers as get_startup_time (or get_shutdown_time) in
+ * utilities.sh does, so they can be read once and used for all displays
+ *
+ * @brief WittyPi2Window::alarmTimeString
+ * @param alarm: which alarm the registers belong to
+ * @param registers: sec (startup alarm only), min, hour and day/date registers
+ * @return e.g. "15 08:??:00", empty if registers could not be read
+ */
+QString WittyPi2Window::alarmTimeString(AlarmEvaluator::Alarm alarm, const QList<int>& registers)
+{
+    if (registers.size() != (alarm == AlarmEvaluator::STARTUP_ALARM ? 4 : 3))
+    {
+        return QString();
+    }
+    QStringList fields;
+    foreach (int reg, registers)
+    {
+        int value = (reg >> 4) * 10 + (reg & 0x0F);
+        fields.prepend(value == 80 ? QString("??") : QString::number(value));
+    }
+    if (alarm == AlarmEvaluator::SHUTDOWN_ALARM)
+    {
+        // shutdown alarm always fires at 00 second
+        fields.append("00");
+    }
+    return fields.at(0) + " " + fields.at(1) + ":" + fields.at(2) + ":" + fields.at(3);
+}
+
+/**
+ * Convert the alarm time to local time, the result is cached as it only
+ * changes with the alarm setting (and the current time zone offset)
+ *
+ * @brief WittyPi2Window::toLocalDateTime
+ * @param datetime: e.g. "15 08:??:00" in UTC
+ * @return the alarm time in local time
+ */
+QString WittyPi2Window::toLocalDateTime(QString datetime)
+{
+    QString hour = QDateTime::currentDateTime().toString("yyyyMMddHH");
+    if (hour != localTimeCacheHour)
+    {
+        localTimeCache.clear();
+        localTimeCacheHour = hour;
+    }
+    if (!localTimeCache.contains(datetime))
+    {
+        localTimeCache.insert(datetime, callUtilFunc(FUNC_GET_LOCAL_DATETIME, "'" + datetime + "'").trimmed());
+    }
+    return localTimeCache.value(datetime);
+}
+
 QString WittyPi2Window::callUtilFunc(QString funcName, QString args, int* exitCode)
 {
     QString cmd = QString("sudo bash -c \". ");
@@ -282,12 +377,17 @@ void WittyPi2Window::reloadTemperature()
     temperatureLabel->setText(TXT_CUR_TEMPERATURE + callUtilFunc(FUNC_GET_TEMPERATURE, NULL));
 }
 
-void WittyPi2Window::reloadShutdownTime()
+void WittyPi2Window::reloadShutdownTime(const QList<int>& registers)
 {
-   QString result = callUtilFunc(FUNC_GET_SHUTDOWN_TIME, NULL).trimmed();
-   if (result.length() > 2 && result != "0 0:0:00")
+   QString result = alarmTimeString(AlarmEvaluator::SHUTDOWN_ALARM, registers);
+   if (result.isEmpty())
    {
-       result = callUtilFunc(FUNC_GET_LOCAL_DATETIME, "'" + result + "'").trimmed();
+       // keep the display if registers could not be read
+       return;
+   }
+   if (result != "0 0:0:00")
+   {
+       result = toLocalDateTime(result);
        QStringList parts = result.split(' ');
        if (parts.size() == 2)
        {
@@ -310,12 +410,17 @@ void WittyPi2Window::reloadShutdownTime()
    }
 }
 
-void WittyPi2Window::reloadStartupTime()
+void WittyPi2Window::reloadStartupTime(const QList<int>& registers)
 {
-    QString result = callUtilFunc(FUNC_GET_STARTUP_TIME, NULL).trimmed();
-    if (result.length() > 2 && result != "0 0:0:0")
+    QString result = alarmTimeString(AlarmEvaluator::STARTUP_ALARM, registers);
+    if (result.isEmpty())
     {
-        result = callUtilFunc(FUNC_GET_LOCAL_DATETIME, "'" + result + "'").trimmed();
+        // keep the display if registers could not be read
+        return;
+    }
+    if (result != "0 0:0:0")
+    {
+        result = toLocalDateTime(result);
         QList<QString> list = parseDateTimeString(result);
         if (list.size() == 4)
         {
@@ -336,6 +441,39 @@ void WittyPi2Window::reloadStartupTime()
     }
 }
 
+/**
+ * Evaluate the alarm registers and display when the alarm will fire
+ *
+ * @brief WittyPi2Window::reloadAlarm
+ * @param label: the label to display
+ * @param alarm: which alarm to evaluate
+ * @param registers: raw alarm registers, empty if they could not be read
+ */
+void WittyPi2Window::reloadAlarm(QLabel* label, AlarmEvaluator::Alarm alarm, const QList<int>& registers)
+{
+    AlarmEvaluator evaluator(alarm, registers);
+    QList<QDateTime> fireTimes = evaluator.nextFireTimes(
+                QDateTime::currentDateTimeUtc(), ALARM_FIRE_TIMES_COUNT);
+    QString text = evaluator.describe();
+    QString tooltip;
+    if (!fireTimes.isEmpty())
+    {
+        text += QString(", next at ") + fireTimes.first().toLocalTime().toString(TXT_FIRE_TIME_FORMAT);
+        tooltip = TXT_NEXT_FIRE_TIMES;
+        foreach (QDateTime dt, fireTimes)
+        {
+            tooltip += QString("\n") + dt.toLocalTime().toString(TXT_FIRE_TIME_FORMAT);
+        }
+    }
+    label->setText(text);
+    label->setToolTip(tooltip);
+
+    // highlight the alarm that may wake up (or shut down) too often
+    bool warning = evaluator.hasReadError() || evaluator.isFrequent()
+            || (!evaluator.isCleared() && !evaluator.isLegalMask());
+    label->setStyleSheet(warning ? QString("color: red") : QString());
+}
+
 void WittyPi2Window::reloadScriptStatus()
 {
     if (usingScript())
@@ -357,6 +495,11 @@ void WittyPi2Window::reloadScriptStatus()
     }
 }
 
+void WittyPi2Window::reloadCycleStats()
+{
+    cycleStatsLabel->setText(callUtilFunc(FUNC_GET_CYCLE_SUMMARY, NULL).trimmed());
+}
+
 bool WittyPi2Window::scheduledShutdown()
 {
     QString result(callUtilFunc(FUNC_GET_SHUTDOWN_TIME, NULL).trimmed());
@@ -388,14 +531,28 @@ void WittyPi2Window::timerEvent(QTimerEvent*)
         // load current temperature and update display
         reloadTemperature();
 
+        // read alarm registers only once, they are used by all alarm displays
+        QList<int> shutdownRegisters = parseRegisterString(callUtilFunc(FUNC_GET_SHUTDOWN_REGISTERS, NULL));
+        QList<int> startupRegisters = parseRegisterString(callUtilFunc(FUNC_GET_STARTUP_REGISTERS, NULL));
+
         // load scheduled shutdown time and update display
-        reloadShutdownTime();
+        reloadShutdownTime(shutdownRegisters);
 
         // load scheduled startup time and update display
-        reloadStartupTime();
+        reloadStartupTime(startupRegisters);
+
+        // evaluate alarms and display the next fire times
+        reloadAlarm(shutdownAlarmLabel, AlarmEvaluator::SHUTDOWN_ALARM, shutdownRegisters);
+        reloadAlarm(startupAlarmLabel, AlarmEvaluator::STARTUP_ALARM, startupRegisters);
 
         // load schedule script usage status
         reloadScriptStatus();
+
+        // keep next transitions in editor up to date
+        if (scheduleEditor->isVisible())
+        {
+            scheduleEditor->refreshSummary();
+        }
     }
 }
 
@@ -568,6 +725,7 @@ void WittyPi2Window::on_chooseScriptButton_clicked()
     if (QFile::copy(scriptFile, WITTYPI_SCHEDULE))
     {
         qDebug() << runScript();
+        reloadCycleStats();
     }
     else
     {
@@ -585,3 +743,28 @@ void WittyPi2Window::on_clearScriptButton_clicked()
         file.remove();
     }
 }
+
+void WittyPi2Window::on_editScriptButton_clicked()
+{
+    if (scheduleEditor->isVisible())
+    {
+        scheduleEditor->hide();
+        editScriptButton->setText(TXT_EDITOR);
+        adjustSize();
+    }
+    else
+    {
+        if (usingScript())
+        {
+            scheduleEditor->loadFile(WITTYPI_SCHEDULE);
+        }
+        scheduleEditor->show();
+        editScriptButton->setText(TXT_HIDE_EDITOR);
+    }
+}
+
+void WittyPi2Window::scheduleScriptApplied()
+{
+    qDebug() << runScript();
+    reloadCycleStats();
+}
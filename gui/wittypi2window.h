@@ -2,12 +2,16 @@
 #define WITTYPI2WINDOW_H
 
 #include <QList>
+#include <QHash>
 #include <QMainWindow>
 #include <QDateTimeEdit>
 #include <QPushButton>
 #include <QLabel>
 #include <QLineEdit>
 
+#include "alarmevaluator.h"
+#include "scheduleeditor.h"
+
 #define WITTYPI_UTILITIES QString("utilities.sh")
 #define WITTYPI_SYNCTIME QString("syncTime.sh")
 #define WITTYPI_SCHEDULE QString("schedule.wpi")
@@ -27,10 +31,15 @@
 #define FUNC_GET_STARTUP_TIME QString("get_startup_time")
 #define FUNC_SET_STARTUP_TIME QString("set_startup_time")
 #define FUNC_CLEAR_STARTUP_TIME QString("clear_startup_time")
+#define FUNC_GET_SHUTDOWN_REGISTERS QString("get_shutdown_registers")
+#define FUNC_GET_STARTUP_REGISTERS QString("get_startup_registers")
 #define FUNC_HAS_INTERNET QString("has_internet")
+#define FUNC_GET_CYCLE_SUMMARY QString("get_cycle_summary")
 
 #define PROP_PREVIOUS_VALUE "prevValue"
 
+#define ALARM_FIRE_TIMES_COUNT 5
+
 #define TXT_WINDOW_TITLE QString("Witty Pi 2")
 #define TXT_CUR_TEMPERATURE QString("Current Temparature: ")
 #define TXT_EDIT QString("Edit")
@@ -41,6 +50,10 @@
 #define TXT_IN_USE QString("in use")
 #define TXT_CHOOSE_SCRIPT QString("Please choose a schedule script")
 #define TXT_SCRIPT_FILETYPE QString("Schedule Script File (*.wpi)")
+#define TXT_EDITOR QString("Editor")
+#define TXT_HIDE_EDITOR QString("Hide")
+#define TXT_NEXT_FIRE_TIMES QString("Next fire times:")
+#define TXT_FIRE_TIME_FORMAT QString("dd/MM/yyyy HH:mm:ss")
 
 namespace Ui {
 class WittyPi2Window;
@@ -81,6 +94,10 @@ private slots:
 
     void on_clearScriptButton_clicked();
 
+    void on_editScriptButton_clicked();
+
+    void scheduleScriptApplied();
+
 private:
     Ui::WittyPi2Window *ui;
 
@@ -101,6 +118,9 @@ private:
     QLabel* scriptLabel;
     QPushButton* clearScriptButton;
     QPushButton* chooseScriptButton;
+    QPushButton* editScriptButton;
+
+    ScheduleEditor* scheduleEditor;
 
     QLineEdit* shutdownDateEdit;
     QLineEdit* shutdownHourEdit;
@@ -116,6 +136,15 @@ private:
     QPushButton* clearStartupButton;
     QPushButton* editStartupButton;
 
+    QLabel* shutdownAlarmLabel;
+    QLabel* startupAlarmLabel;
+
+    // local time of alarm settings, only valid within the hour it was converted
+    QHash<QString, QString> localTimeCache;
+    QString localTimeCacheHour;
+
+    QLabel* cycleStatsLabel;
+
     void keyPressEvent(QKeyEvent* event);
 
     QString callUtilFunc(QString funcName, QString args, int* exitCode=NULL);
@@ -126,6 +155,12 @@ private:
 
     QList<QString> parseDateTimeString(QString datetime, int mode=0);
 
+    QList<int> parseRegisterString(QString registers);
+
+    QString alarmTimeString(AlarmEvaluator::Alarm alarm, const QList<int>& registers);
+
+    QString toLocalDateTime(QString datetime);
+
     bool scheduledShutdown();
     bool scheduledStartup();
     bool usingScript();
@@ -136,9 +171,11 @@ private:
     void reloadWittyPiTime();
     void reloadRaspberryPiTime();
     void reloadTemperature();
-    void reloadShutdownTime();
-    void reloadStartupTime();
+    void reloadShutdownTime(const QList<int>& registers);
+    void reloadStartupTime(const QList<int>& registers);
+    void reloadAlarm(QLabel* label, AlarmEvaluator::Alarm alarm, const QList<int>& registers);
     void reloadScriptStatus();
+    void reloadCycleStats();
 };
 
 #endif // WITTYPI2WINDOW_H
@@ -46,15 +46,31 @@ is_rtc_connected
 has_rtc=$?  # should be 0 if RTC presents
 
 if [ $has_rtc == 0 ] ; then
+  # record the RTC time as early as possible
+  wake_time=$(current_timestamp)
+
   # disable square wave and enable alarms
   i2c_write 0x01 0x68 0x0E 0x07
 
   byte_F=$(i2c_read 0x01 0x68 0x0F)
 
+  # record how and when this cycle begins
+  trim_cycle_log
+  if [ $((($byte_F&0x1) != 0)) == '1' ] ; then
+    log_cycle_event $EVENT_WAKE $SOURCE_ALARM_A $wake_time $(get_startup_timestamp $wake_time)
+  elif [ $((($byte_F&0x2) != 0)) == '1' ] ; then
+    log_cycle_event $EVENT_WAKE $SOURCE_ALARM_B $wake_time 0
+  else
+    log_cycle_event $EVENT_WAKE $SOURCE_BUTTON $wake_time 0
+  fi
+
   # if woke up by alarm B (shutdown), turn it off immediately
   if [ $((($byte_F&0x1) == 0)) == '1' ] && [ $((($byte_F&0x2) != 0)) == '1' ] ; then
     log 'Seems I was unexpectedly woken up by shutdown alarm, must go back to sleep...'
-    do_shutdown $HALT_PIN $LED_PIN $has_rtc
+    shutdown_source=$SOURCE_ALARM_B
+    do_shutdown $HALT_PIN $LED_PIN $has_rtc $SOURCE_ALARM_B
+    # system is going down, do not start anything else
+    exit
   fi
 
   # clear alarm flags
@@ -63,6 +79,9 @@ else
   log 'Witty Pi is not connected, skip I2C communications...'
 fi
 
+# run on-wake hooks in background
+run_hooks on-wake $ON_WAKE_HOOK_BUDGET &
+
 # synchronize time
 if [ $has_rtc == 0 ] ; then
   "$cur_dir/syncTime.sh" &
@@ -94,10 +113,28 @@ done
 # run extra tasks in background
 "$cur_dir/extraTasks.sh" >> "$cur_dir/wittyPi.log" 2>&1 &
 
+# record the shutdown that is not requested by Witty Pi (e.g. "shutdown" command)
+on_terminate()
+{
+  if [ -z "$shutdown_source" ] && [ $has_rtc == 0 ] ; then
+    # system time is synchronized by now, and reading RTC may be too slow here
+    log_cycle_event $EVENT_SHUTDOWN $SOURCE_EXTERNAL $(date +%s) 0
+  fi
+  if [ ! -z "$wfi_pid" ] ; then
+    kill $wfi_pid 2>/dev/null
+  fi
+  exit
+}
+trap on_terminate TERM
+
 # wait for GPIO-4 (BCM naming) falling, or alarm B (shutdown)
 log 'Pending for incoming shutdown command...'
 while true; do
-  gpio -g wfi $HALT_PIN falling
+  # wait in background, so the TERM signal can be handled while waiting
+  gpio -g wfi $HALT_PIN falling &
+  wfi_pid=$!
+  unset shutdown_source
+  wait $wfi_pid
   if [ $has_rtc == 0 ] ; then
     byte_F=$(i2c_read 0x01 0x68 0x0F)
     if [ $((($byte_F&0x1) != 0)) == '1' ] && [ $((($byte_F&0x2) == 0)) == '1' ] ; then
@@ -105,13 +142,19 @@ while true; do
       log 'Startup alarm occurs in ON state, ignored'
       clear_alarm_flags
     else
+      if [ $((($byte_F&0x2) != 0)) == '1' ] ; then
+        shutdown_source=$SOURCE_ALARM_B
+      else
+        shutdown_source=$SOURCE_BUTTON
+      fi
       break;
     fi
   else
     # power switch can still work without RTC
+    shutdown_source=$SOURCE_BUTTON
     break;
   fi
 done
 log 'Shutdown command is received...'
 
-do_shutdown $HALT_PIN $LED_PIN $has_rtc
+do_shutdown $HALT_PIN $LED_PIN $has_rtc $shutdown_source
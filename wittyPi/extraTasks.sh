@@ -3,4 +3,6 @@
 #
 # This script will be launched in background after Witty Pi 2 get initialized.
 # If you want to run your commands after boot, you can place them here.
+# If your commands need to start earlier, or need to run before shutdown,
+# please use hooks instead (see hooks/README).
 #
@@ -22,7 +22,14 @@ case "$1" in
     stop)
         echo "Stopping Witty Pi 2 Daemon..."
 	daemonPid=$(cat /var/run/wittypi_daemon.pid)
-	kill -9 $daemonPid
+	# let daemon record the shutdown, then make sure it is gone
+	kill $daemonPid
+	counter=0
+	while [ $counter -lt 50 ] && kill -0 $daemonPid 2>/dev/null; do
+	  sleep 0.1
+	  counter=$(($counter+1))
+	done
+	kill -9 $daemonPid 2>/dev/null
         ;;
     *)
         echo "Usage: /etc/init.d/wittypi start|stop"
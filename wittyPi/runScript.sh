@@ -78,6 +78,7 @@ setup_off_state()
   IFS=' ' read -r date timestr <<< "$when"
   IFS=':' read -r hour minute second <<< "$timestr"
   set_startup_time $date $hour $minute $second
+  log_cycle_event $EVENT_ARMED $SOURCE_ALARM_A $(date +%s) $1
 }
 
 setup_on_state()
@@ -90,6 +91,7 @@ setup_on_state()
   IFS=' ' read -r date timestr <<< "$when"
   IFS=':' read -r hour minute second <<< "$timestr"
   set_shutdown_time $date $hour $minute
+  log_cycle_event $EVENT_ARMED $SOURCE_ALARM_B $(date +%s) $(($1-$1%60))
 }
 
 if [ -f $schedule_file ]; then
@@ -130,6 +132,7 @@ if [ -f $schedule_file ]; then
       if [ ! -z "$2" ] && [ $interrupted == 0 ] ; then
         log 'Schedule script is interrupted, revising the schedule...'
       fi
+      run_hooks before-arm $BEFORE_ARM_HOOK_BUDGET
       index=0
       found_states=0
       check_time=$begin
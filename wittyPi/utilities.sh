@@ -10,6 +10,27 @@ HALT_PIN=4
 # LED on GPIO-17 (BCM naming)
 LED_PIN=17
 
+# event types and sources in cycle telemetry
+EVENT_WAKE=1
+EVENT_ARMED=2
+EVENT_SHUTDOWN=3
+SOURCE_NONE=0
+SOURCE_BUTTON=1
+SOURCE_ALARM_A=2
+SOURCE_ALARM_B=3
+SOURCE_EXTERNAL=4
+
+# cycle telemetry keeps at most this many records (12 bytes each)
+CYCLE_LOG_MAX_RECORDS=16384
+
+# default time budget (in seconds) for hooks, can be overridden by "# budget: N" in hook file
+ON_WAKE_HOOK_BUDGET=60
+BEFORE_ARM_HOOK_BUDGET=10
+BEFORE_SHUTDOWN_HOOK_BUDGET=30
+
+# before-shutdown hooks can never delay shutdown longer than this (in seconds)
+MAX_BEFORE_SHUTDOWN_HOOK_BUDGET=120
+
 
 one_wire_confliction()
 {
@@ -254,6 +275,15 @@ get_startup_time()
   echo "$date $hour:$min:$sec"
 }
 
+get_startup_registers()
+{
+  local sec=$(i2c_read 0x01 0x68 0x07)
+  local min=$(i2c_read 0x01 0x68 0x08)
+  local hour=$(i2c_read 0x01 0x68 0x09)
+  local date=$(i2c_read 0x01 0x68 0x0A)
+  echo "$sec $min $hour $date"
+}
+
 set_startup_time()
 {
   i2c_write 0x01 0x68 0x0E 0x07
@@ -308,6 +338,14 @@ get_shutdown_time()
   echo "$date $hour:$min:00"
 }
 
+get_shutdown_registers()
+{
+  local min=$(i2c_read 0x01 0x68 0x0B)
+  local hour=$(i2c_read 0x01 0x68 0x0C)
+  local date=$(i2c_read 0x01 0x68 0x0D)
+  echo "$min $hour $date"
+}
+
 set_shutdown_time()
 {
   i2c_write 0x01 0x68 0x0E 0x07
@@ -485,6 +523,11 @@ do_shutdown()
   local halt_pin=$1
   local led_pin=$2
   local has_rtc=$3
+  local source=$4
+
+  if [ $has_rtc == 0 ] && [ ! -z "$source" ] ; then
+    log_cycle_event $EVENT_SHUTDOWN $source $(date +%s) 0
+  fi
 
   # light the white LED
   gpio -g mode $led_pin out
@@ -494,12 +537,40 @@ do_shutdown()
   gpio -g mode $halt_pin in
   gpio -g mode $halt_pin up
 
+  local max_budget=$MAX_BEFORE_SHUTDOWN_HOOK_BUDGET
   if [ $has_rtc == 0 ] ; then
     # clear alarm flags
     clear_alarm_flags
 
-    # only enable alarm A (startup)
+    # only enable alarm A (startup), before the hooks so it can not be missed
     i2c_write 0x01 0x68 0x0E 0x05
+
+    # hooks should not run past the next startup
+    local next_startup=$(get_next_startup_timestamp $(date +%s))
+    if [ $next_startup != 0 ] ; then
+      local remaining=$((next_startup-$(date +%s)))
+      if [ $((remaining < max_budget)) == '1' ] ; then
+        max_budget=$remaining
+      fi
+    fi
+  fi
+
+  # give hooks the chance to finish their jobs
+  if [ $((max_budget > 0)) == '1' ] ; then
+    run_hooks before-shutdown $BEFORE_SHUTDOWN_HOOK_BUDGET $max_budget
+  else
+    log 'Startup is due, skip before-shutdown hooks.'
+  fi
+
+  if [ $has_rtc == 0 ] ; then
+    # alarm A may have fired while hooks were running, halting now would miss that startup
+    local byte_F=$(i2c_read 0x01 0x68 0x0F)
+    if [ $(($byte_F&0x1)) != 0 ] ; then
+      clear_alarm_flags $byte_F
+      log 'Startup alarm fired during shutdown, rebooting Raspberry Pi instead...'
+      shutdown -r now
+      return
+    fi
   fi
 
   log 'Halting all processes and then shutdown Raspberry Pi...'
@@ -523,4 +594,222 @@ schedule_script_interrupted()
     fi
   fi
   return 1
-}
\ No newline at end of file
+}
+
+get_startup_timestamp()
+{
+  # get the latest startup alarm time that is not later than given timestamp
+  find_startup_timestamp $1 -1
+}
+
+get_next_startup_timestamp()
+{
+  # get the earliest startup alarm time that is later than given timestamp
+  find_startup_timestamp $1 1
+}
+
+find_startup_timestamp()
+{
+  local ref=$1
+  local dir=$2
+  IFS=' ' read -r date timestr <<< "$(get_startup_time)"
+  IFS=':' read -r hour minute second <<< "$timestr"
+  if [ "$second" == '??' ] ; then
+    # fires every second, there is no meaningful previous startup time
+    if [ $dir -gt 0 ] ; then
+      echo $((ref+1))
+    else
+      echo 0
+    fi
+    return
+  fi
+  second=$(printf '%02d' $((10#$second)))
+  local period=0
+  local when=''
+  if [ "$minute" == '??' ] ; then
+    when="$(date -u -d @$ref +'%Y-%m-%d %H:%M'):$second"
+    period=60
+  else
+    minute=$(printf '%02d' $((10#$minute)))
+    if [ "$hour" == '??' ] ; then
+      when="$(date -u -d @$ref +'%Y-%m-%d %H'):$minute:$second"
+      period=3600
+    else
+      hour=$(printf '%02d' $((10#$hour)))
+      if [ "$date" == '??' ] ; then
+        when="$(date -u -d @$ref +'%Y-%m-%d') $hour:$minute:$second"
+        period=86400
+      else
+        date=$(printf '%02d' $((10#$date)))
+      fi
+    fi
+  fi
+  local ts=''
+  if [ $period != 0 ] ; then
+    ts=$(date -u -d "$when" +%s 2>/dev/null)
+    if [ "$ts" != "" ] ; then
+      if [ $dir -lt 0 ] && [ $((ts > ref)) == '1' ] ; then
+        ts=$((ts-period))
+      elif [ $dir -gt 0 ] && [ $((ts <= ref)) == '1' ] ; then
+        ts=$((ts+period))
+      fi
+    fi
+  else
+    # walk month by month, skipping the months that do not have this date
+    local month=$(date -u -d @$ref +%Y-%m-15)
+    local i
+    for i in 0 1 2 3 ; do
+      when="$(date -u -d "$month $((dir*i)) month" +'%Y-%m-')$date $hour:$minute:$second"
+      ts=$(date -u -d "$when" +%s 2>/dev/null)
+      if [ "$ts" != "" ] ; then
+        if [ $dir -lt 0 ] && [ $((ts <= ref)) == '1' ] ; then
+          break
+        elif [ $dir -gt 0 ] && [ $((ts > ref)) == '1' ] ; then
+          break
+        fi
+      fi
+      ts=''
+    done
+  fi
+  if [ "$ts" == "" ] ; then
+    echo 0
+  else
+    echo $ts
+  fi
+}
+
+uint32_le()
+{
+  local v=$1
+  printf '\\x%02x\\x%02x\\x%02x\\x%02x' $((v&0xFF)) $((v>>8&0xFF)) $((v>>16&0xFF)) $((v>>24&0xFF))
+}
+
+log_cycle_event()
+{
+  # append a 12 bytes record: time, reference time, type|source<<8 (uint32 LE)
+  local type=$1
+  local source=$2
+  local time=$3
+  local ref=$4
+  printf "$(uint32_le $time)$(uint32_le $ref)$(uint32_le $((type|source<<8)))" >> $wittypi_home/cycles.dat
+}
+
+trim_cycle_log()
+{
+  # keep only the latest records, so the log (and summary) does not grow forever
+  local file="$wittypi_home/cycles.dat"
+  if [ ! -f "$file" ] ; then
+    return
+  fi
+  local max_size=$((CYCLE_LOG_MAX_RECORDS*12))
+  local size=$(stat -c %s "$file")
+  if [ $((size > max_size)) == '1' ] ; then
+    tail -c $max_size "$file" > "$file.tmp" && mv "$file.tmp" "$file"
+  fi
+}
+
+get_cycle_summary()
+{
+  local file="$wittypi_home/cycles.dat"
+  if [ ! -s "$file" ] ; then
+    echo 'No cycle recorded yet.'
+    return
+  fi
+  # wake latencies are printed as "L <seconds>" lines and sorted outside, as mawk has no asort
+  local summary=$(tail -c $((CYCLE_LOG_MAX_RECORDS*12)) "$file" | od -An -v -tu4 -w12 | awk \
+    -v wake=$EVENT_WAKE -v armed=$EVENT_ARMED -v off=$EVENT_SHUTDOWN \
+    -v btn=$SOURCE_BUTTON -v alm_a=$SOURCE_ALARM_A -v alm_b=$SOURCE_ALARM_B -v ext=$SOURCE_EXTERNAL '
+  function close_cycle(next_wake) {
+    if (up > 0 && down > 0 && next_wake > up) {
+      cycles++
+      on_sum += down - up
+      period_sum += next_wake - up
+    }
+    if (prog > 0 && next_off > prog && next_on > next_off) {
+      sched_on_sum += next_off - prog
+      sched_period_sum += next_on - prog
+    }
+  }
+  {
+    type = $3 % 256
+    source = int($3 / 256)
+    if (type == wake) {
+      close_cycle($1)
+      up = $1; prog = $2; down = 0; next_off = 0; next_on = 0
+      if (prog > 0 && $1 >= prog) print "L " $1 - prog
+    } else if (type == armed) {
+      if (source == alm_a) next_on = $2
+      else if (source == alm_b) next_off = $2
+    } else if (type == off) {
+      if (up > 0 && down == 0) down = $1
+      sources[source]++
+    }
+  }
+  END {
+    printf "Duty cycle: "
+    if (period_sum > 0) printf "%.1f%% actual", on_sum * 100 / period_sum
+    else printf "n/a actual"
+    if (sched_period_sum > 0) printf ", %.1f%% scheduled", sched_on_sum * 100 / sched_period_sum
+    else printf ", n/a scheduled"
+    printf " (%d cycles)\n", cycles
+    printf "Shutdown by: button %d, alarm %d, external %d\n", sources[btn], sources[alm_b], sources[ext]
+  }')
+  echo "$summary" | sed -n 's/^L //p' | sort -n | awk '
+  function rank(p,    k) {
+    k = int(NR * p / 100)
+    if (k < NR * p / 100) k++
+    if (k < 1) k = 1
+    return k
+  }
+  { lat[NR] = $1 }
+  END {
+    if (NR > 0) printf "Wake latency: p50 %ds, p99 %ds (%d wakes)\n", lat[rank(50)], lat[rank(99)], NR
+    else print "Wake latency: no alarm wake recorded"
+  }'
+  echo "$summary" | grep -v '^L '
+}
+
+run_hook()
+{
+  local stage=$1
+  local hook=$2
+  # budget must be positive, as "timeout 0" means no time limit
+  local budget=$(sed -n 's/^#[[:space:]]*budget:[[:space:]]*\([1-9][0-9]\{0,5\}\)\([^0-9].*\)\?$/\1/p' "$hook" | head -n 1)
+  if [ -z "$budget" ] ; then
+    budget=$3
+  fi
+  if [ ! -z "$4" ] && [ $((budget > $4)) == '1' ] ; then
+    budget=$4
+  fi
+  local start=$(date +%s%N)
+  WITTYPI_HOOK=$stage timeout -k 1 $budget "$hook" >> $wittypi_home/wittyPi.log 2>&1
+  local result=$?
+  local elapsed=$((($(date +%s%N)-start)/1000000))
+  if [ $result == 124 ] || [ $result == 137 ] ; then
+    log "Hook $stage/${hook##*/} timed out after ${elapsed}ms (budget ${budget}s)"
+  else
+    log "Hook $stage/${hook##*/} finished in ${elapsed}ms (exit code $result)"
+  fi
+}
+
+run_hooks()
+{
+  # run all executables in hooks/<stage>.d in parallel, and wait until they finish or time out
+  local stage=$1
+  local budget=$2
+  local max_budget=$3
+  local dir="$wittypi_home/hooks/$stage.d"
+  if [ ! -d "$dir" ] ; then
+    return
+  fi
+  local pids=()
+  for hook in "$dir"/* ; do
+    if [ -f "$hook" ] && [ -x "$hook" ] ; then
+      run_hook $stage "$hook" $budget $max_budget &
+      pids+=($!)
+    fi
+  done
+  if [ ${#pids[@]} -gt 0 ] ; then
+    wait ${pids[@]}
+  fi
+}
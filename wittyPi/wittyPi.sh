@@ -246,6 +246,9 @@ while true; do
     rtctime+="$(get_rtc_time)"
     echo "$rtctime"
 
+    # output cycle statistics
+    get_cycle_summary | sed 's/^/>>> /'
+
     # let user choose action
     echo 'Now you can:'
     echo '  1. Write system time to RTC'